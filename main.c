@@ -3,12 +3,18 @@
 #include "tag.h"
 #include <stdlib.h> // for exit
 
+#define DEFAULT_ORGANIZE_TEMPLATE "%a/%A/%T - %t.mp3"
+
 // Show usage info
 void print_usage(const char *program)
 {
     printf("Usage:\n");
     printf("  %s -v <mp3_filename>\n", program);
-    printf("  %s -e -<option> <new_value> <mp3_filename>\n", program);
+    printf("  %s -e [--snapshot <archive>] -<option> <new_value> <mp3_filename>\n", program);
+    printf("  %s -o [--dry-run] [--link] [--schedule] [--template <fmt>] <dest_dir> <mp3_files...>\n", program);
+    printf("  %s -b <mp3_files...>   (cold-cache scan benchmark)\n", program);
+    printf("  %s -s <archive> <mp3_files...>   (snapshot original tags)\n", program);
+    printf("  %s -r [--oldest] [--no-verify] <archive> [mp3_files...]   (roll back from snapshot)\n", program);
     printf("  %s --help / -h\n", program); 
     printf("Options for -e:\n");
     printf("  -t   Edit Title\n");
@@ -19,6 +25,13 @@ void print_usage(const char *program)
     printf("  -g   Edit Genre\n");
     printf("  -T   Edit Track\n"); 
     printf("  -C   Edit Comment\n");
+    printf("Options for -o (organize into <dest_dir> by rename/hardlink, never copying):\n");
+    printf("  --dry-run          Print the plan without moving anything\n");
+    printf("  --link             Hardlink files instead of moving them\n");
+    printf("  --schedule         Read tags in on-disk order with tag-sized readahead (HDDs)\n");
+    printf("  --template <fmt>   Path template (default \"%s\")\n", DEFAULT_ORGANIZE_TEMPLATE);
+    printf("                     %%t Title, %%a Artist, %%A Album, %%y Year, %%c Composer,\n");
+    printf("                     %%g Genre, %%T Track (2 digits), %%C Comment\n");
 }
 
 int main(int argc, char *argv[])
@@ -50,12 +63,14 @@ int main(int argc, char *argv[])
             return FAILURE;
         }
     }
-    // Edit tag
-    else if (argc == 5 && strcmp(argv[1], "-e") == 0)
+    // Edit tag (optionally snapshotting the original tag first)
+    else if ((argc == 5 || (argc == 7 && strcmp(argv[2], "--snapshot") == 0)) && strcmp(argv[1], "-e") == 0)
     {
-        const char *edit_flag = argv[2];
-        const char *new_value = argv[3];
-        const char *filename = argv[4];
+        const char *archive = argc == 7 ? argv[3] : NULL;
+        int arg = argc == 7 ? 4 : 2;
+        const char *edit_flag = argv[arg];
+        const char *new_value = argv[arg + 1];
+        const char *filename = argv[arg + 2];
         const char *frame_id = NULL; // ID3v2 compatible ID
 
         if (!mp3_extn(filename))
@@ -92,6 +107,12 @@ int main(int argc, char *argv[])
 
         printf("------------------------ Selected %s change option ---------------------\n", field_name);
 
+        if (archive && snapshot_mp3_tags(archive, (char **)&filename, 1) != SUCCESS)
+        {
+            printf("Snapshot failed; tag left unchanged.\n");
+            return FAILURE;
+        }
+
         if (edit_mp3_tag(filename, frame_id, new_value) == SUCCESS)
         {
             printf("%s        : %s\n", field_name, new_value);
@@ -103,6 +124,84 @@ int main(int argc, char *argv[])
             return FAILURE;
         }
     }
+    // Organize files into a tag-driven directory layout
+    else if (argc >= 4 && strcmp(argv[1], "-o") == 0)
+    {
+        const char *tpl = DEFAULT_ORGANIZE_TEMPLATE;
+        int flags = 0;
+        int i = 2;
+
+        for (; i < argc && strncmp(argv[i], "--", 2) == 0; i++)
+        {
+            if (strcmp(argv[i], "--dry-run") == 0) flags |= ORGANIZE_DRY_RUN;
+            else if (strcmp(argv[i], "--link") == 0) flags |= ORGANIZE_HARDLINK;
+            else if (strcmp(argv[i], "--schedule") == 0) flags |= ORGANIZE_SCHEDULE;
+            else if (strcmp(argv[i], "--template") == 0 && i + 1 < argc) tpl = argv[++i];
+            else
+            {
+                printf("Unknown organize option: %s\n", argv[i]);
+                print_usage(argv[0]);
+                return FAILURE;
+            }
+        }
+
+        if (argc - i < 2)
+        {
+            print_usage(argv[0]);
+            return FAILURE;
+        }
+
+        const char *dest_dir = argv[i];
+        if (organize_mp3_files(dest_dir, tpl, &argv[i + 1], argc - i - 1, flags) != SUCCESS)
+        {
+            return FAILURE;
+        }
+    }
+    // Snapshot original tags before a batch of edits
+    else if (argc >= 4 && strcmp(argv[1], "-s") == 0)
+    {
+        if (snapshot_mp3_tags(argv[2], &argv[3], argc - 3) != SUCCESS)
+        {
+            return FAILURE;
+        }
+    }
+    // Roll tags back from a snapshot archive
+    else if (argc >= 3 && strcmp(argv[1], "-r") == 0)
+    {
+        int flags = 0;
+        int i = 2;
+
+        for (; i < argc && strncmp(argv[i], "--", 2) == 0; i++)
+        {
+            if (strcmp(argv[i], "--oldest") == 0) flags |= ROLLBACK_OLDEST;
+            else if (strcmp(argv[i], "--no-verify") == 0) flags |= ROLLBACK_NO_VERIFY;
+            else
+            {
+                printf("Unknown rollback option: %s\n", argv[i]);
+                print_usage(argv[0]);
+                return FAILURE;
+            }
+        }
+
+        if (i >= argc)
+        {
+            print_usage(argv[0]);
+            return FAILURE;
+        }
+
+        if (rollback_mp3_tags(argv[i], &argv[i + 1], argc - i - 1, flags) != SUCCESS)
+        {
+            return FAILURE;
+        }
+    }
+    // Benchmark cold-cache scanning with and without the scan scheduler
+    else if (argc >= 3 && strcmp(argv[1], "-b") == 0)
+    {
+        if (benchmark_scan(&argv[2], argc - 2) != SUCCESS)
+        {
+            return FAILURE;
+        }
+    }
     else
     {
         print_usage(argv[0]);
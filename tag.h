@@ -27,6 +27,21 @@ typedef struct
     char image_details[128]; 
 } ID3v2Tag;
 
+// Flags for organize_mp3_files()
+typedef enum
+{
+    ORGANIZE_DRY_RUN  = 1 << 0, // Print the plan, touch nothing
+    ORGANIZE_HARDLINK = 1 << 1, // Hardlink instead of moving
+    ORGANIZE_SCHEDULE = 1 << 2  // Read tags in on-disk order (tag_schedule.c)
+} OrganizeFlags;
+
+// Flags for rollback_mp3_tags()
+typedef enum
+{
+    ROLLBACK_OLDEST    = 1 << 0, // Restore the first snapshot of each file, not the latest
+    ROLLBACK_NO_VERIFY = 1 << 1  // Skip the audio payload checksum
+} RollbackFlags;
+
 // Prototypes from tag_read.c
 Status read_mp3_tag(const char *filename, ID3v2Tag *tag);
 void print_tag(const ID3v2Tag *tag);
@@ -37,6 +52,24 @@ Status read_mp3_tag_v1(const char *filename, ID3v2Tag *tag);
 
 // Prototypes from tag_edit.c
 Status edit_mp3_tag(const char *filename, const char *frame_id_in, const char *new_value);
+Status replace_file_contents(const char *filename, const unsigned char *data, long size);
+
+// Prototypes from tag_snapshot.c
+Status snapshot_mp3_tags(const char *archive, char **files, int count);
+Status rollback_mp3_tags(const char *archive, char **files, int count, int flags);
+
+// Prototypes from tag_organize.c
+Status organize_mp3_files(const char *dest_dir, const char *tpl, char **files, int count, int flags);
+
+// Called by scan_mp3_tags() for each file; tag is NULL when none could be read
+typedef void (*TagScanCallback)(int index, const ID3v2Tag *tag, void *ctx);
+
+// Prototypes from tag_schedule.c
+Status schedule_scan_order(char **files, int count, int *order);
+void advise_tag_readahead(const char *filename);
+Status scan_mp3_tags(char **files, const int *order, int count, int hinted,
+                     TagScanCallback on_tag, void *ctx);
+Status benchmark_scan(char **files, int count);
 
 // Prototypes from tag_utils.c
 int read_big_endian_int(unsigned char *bytes);
@@ -46,5 +79,7 @@ void write_synchsafe_int(int value, unsigned char *bytes);
 int get_mp3_version(FILE *fp);
 int mp3_extn(const char *filename);
 int valid_year(const char *str);
+int utf8_char_len(const unsigned char *s);
+int decode_id3_text(int encoding, const unsigned char *data, int len, char *out, int out_size);
 
 #endif // TAG_H
\ No newline at end of file
@@ -5,6 +5,34 @@
 #include "tag.h"
 #include "colour.h"
 
+// Writes data to <filename>_temp.mp3, then swaps it in place of filename
+Status replace_file_contents(const char *filename, const unsigned char *data, long size)
+{
+    char temp_file[4096];
+    snprintf(temp_file, sizeof(temp_file), "%s_temp.mp3", filename);
+    FILE *out = fopen(temp_file, "wb");
+    if (!out) { 
+        perror(RED "Error writing temp file" RESET);
+        return FAILURE; 
+    }
+    if (fwrite(data, 1, size, out) != (size_t)size) {
+        perror(RED "Error writing temp file" RESET);
+        fclose(out); remove(temp_file);
+        return FAILURE;
+    }
+    fclose(out);
+
+    if (remove(filename) != 0) { 
+        perror(RED "Error removing original file" RESET); 
+        remove(temp_file); return FAILURE; 
+    }
+    if (rename(temp_file, filename) != 0) { 
+        perror(RED "Error renaming temp file" RESET); 
+        return FAILURE; 
+    }
+    return SUCCESS;
+}
+
 Status edit_mp3_tag(const char *filename, const char *frame_id_in, const char *new_value)
 {
     FILE *fp = fopen(filename, "rb");
@@ -139,29 +167,10 @@ Status edit_mp3_tag(const char *filename, const char *frame_id_in, const char *n
             new_tag_size = new_tag_size & 0x0FFFFFFF;
             write_synchsafe_int(new_tag_size, &new_buf[6]);
 
-            // Write to temp file, rename, and clean up
-            char temp_file[256];
-            snprintf(temp_file, sizeof(temp_file), "%s_temp.mp3", filename);
-            FILE *out = fopen(temp_file, "wb");
-            if (!out) { 
-                perror(RED "Error writing temp file" RESET); free(buffer); free(new_buf); 
-                return FAILURE; 
-            }
-            fwrite(new_buf, 1, new_file_size, out);
-            fclose(out);
-
             free(buffer);
+            Status status = replace_file_contents(filename, new_buf, new_file_size);
             free(new_buf);
-
-            if (remove(filename) != 0) { 
-                perror(RED "Error removing original file" RESET); 
-                remove(temp_file); return FAILURE; 
-            }
-            if (rename(temp_file, filename) != 0) { 
-                perror(RED "Error renaming temp file" RESET); 
-                return FAILURE; 
-            }
-            return SUCCESS;
+            return status;
         }
         pos += 10 + frame_size;
     }
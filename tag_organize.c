@@ -0,0 +1,442 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include "tag.h"
+#include "colour.h"
+
+#ifndef RENAME_NOREPLACE
+#define RENAME_NOREPLACE (1 << 0)
+#endif
+
+#define MAX_COMPONENT_LEN 200   // Leaves room for " (N)" below NAME_MAX
+#define MAX_COLLISIONS    1000
+
+// One file to organize: source path and the rendered relative target
+typedef struct
+{
+    const char *src;
+    char *rel;
+} OrganizeJob;
+
+// Context for the tag reading phase
+typedef struct
+{
+    OrganizeJob *jobs;
+    const char *tpl;
+} OrganizeWork;
+
+// Simple open-addressing string set (created directories / planned targets)
+typedef struct
+{
+    char **slots;
+    size_t cap;
+    size_t count;
+} PathSet;
+
+// FNV-1a hash for path strings
+static size_t hash_path(const char *s)
+{
+    size_t h = 2166136261u;
+    while (*s)
+    {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void pathset_free(PathSet *set)
+{
+    for (size_t i = 0; i < set->cap; i++)
+        free(set->slots[i]);
+    free(set->slots);
+    memset(set, 0, sizeof(*set));
+}
+
+static int pathset_contains(const PathSet *set, const char *path)
+{
+    if (set->cap == 0) return 0;
+    size_t i = hash_path(path) & (set->cap - 1);
+    while (set->slots[i])
+    {
+        if (strcmp(set->slots[i], path) == 0) return 1;
+        i = (i + 1) & (set->cap - 1);
+    }
+    return 0;
+}
+
+// Inserts a copy of path; returns 1 if newly added, 0 if present, -1 on error
+static int pathset_add(PathSet *set, const char *path)
+{
+    if (pathset_contains(set, path)) return 0;
+
+    // Keep load factor under 50%
+    if ((set->count + 1) * 2 > set->cap)
+    {
+        size_t new_cap = set->cap ? set->cap * 2 : 256;
+        char **new_slots = calloc(new_cap, sizeof(char *));
+        if (!new_slots) return -1;
+        for (size_t i = 0; i < set->cap; i++)
+        {
+            if (!set->slots[i]) continue;
+            size_t j = hash_path(set->slots[i]) & (new_cap - 1);
+            while (new_slots[j]) j = (j + 1) & (new_cap - 1);
+            new_slots[j] = set->slots[i];
+        }
+        free(set->slots);
+        set->slots = new_slots;
+        set->cap = new_cap;
+    }
+
+    char *copy = strdup(path);
+    if (!copy) return -1;
+    size_t i = hash_path(path) & (set->cap - 1);
+    while (set->slots[i]) i = (i + 1) & (set->cap - 1);
+    set->slots[i] = copy;
+    set->count++;
+    return 1;
+}
+
+// Appends a tag value, replacing characters that are unsafe in file names
+// and any bytes that are not valid UTF-8
+static void append_field(char *out, size_t *len, size_t out_size, const char *value)
+{
+    if (value == NULL || value[0] == '\0') value = "Unknown";
+
+    const unsigned char *p = (const unsigned char *)value;
+    while (*p)
+    {
+        int step = utf8_char_len(p);
+        if (step > 1)
+        {
+            if (*len + step >= out_size) break;
+            memcpy(out + *len, p, step);
+            *len += step;
+            p += step;
+            continue;
+        }
+
+        if (*len + 1 >= out_size) break;
+        unsigned char c = *p++;
+        if (step == 0 || c < 0x20 || c == 0x7F || strchr("/\\:*?\"<>|", c))
+            c = '_';
+        out[(*len)++] = (char)c;
+    }
+    out[*len] = '\0';
+}
+
+// Cleans every path component: trims spaces and dots, caps length
+static void sanitize_components(char *path, size_t path_size)
+{
+    char clean[4096];
+    size_t len = 0;
+    const char *read = path;
+
+    while (*read)
+    {
+        const char *end = strchr(read, '/');
+        size_t comp_len = end ? (size_t)(end - read) : strlen(read);
+        size_t orig_len = comp_len;
+
+        const char *start = read;
+        while (comp_len > 0 && (*start == ' ' || *start == '.')) { start++; comp_len--; }
+        while (comp_len > 0 && (start[comp_len - 1] == ' ' || start[comp_len - 1] == '.')) comp_len--;
+        if (comp_len > MAX_COMPONENT_LEN)
+        {
+            // Back off so the cut never splits a multibyte UTF-8 sequence
+            comp_len = MAX_COMPONENT_LEN;
+            while (comp_len > 0 && ((unsigned char)start[comp_len] & 0xC0) == 0x80) comp_len--;
+        }
+
+        // Components made only of dots/spaces (e.g. "..") become "Unknown"
+        if (comp_len == 0 && orig_len > 0)
+        {
+            start = "Unknown";
+            comp_len = 7;
+        }
+
+        // Empty components ("//", leading "/") are dropped
+        if (comp_len > 0 && len + comp_len + 2 < sizeof(clean))
+        {
+            if (len > 0) clean[len++] = '/';
+            memcpy(clean + len, start, comp_len);
+            len += comp_len;
+        }
+
+        read = end ? end + 1 : read + strlen(read);
+    }
+    clean[len] = '\0';
+    snprintf(path, path_size, "%s", clean);
+}
+
+// Renders the path template using the same letters as the -e options
+// %t Title, %a Artist, %A Album, %y Year, %c Composer, %g Genre, %T Track, %C Comment, %% literal
+static char *render_template(const char *tpl, const ID3v2Tag *tag)
+{
+    char out[4096];
+    size_t len = 0;
+    out[0] = '\0';
+
+    for (const char *p = tpl; *p && len + 1 < sizeof(out); p++)
+    {
+        if (*p != '%' || p[1] == '\0')
+        {
+            out[len++] = *p;
+            out[len] = '\0';
+            continue;
+        }
+
+        char track[8];
+        p++;
+        switch (*p)
+        {
+            case 't': append_field(out, &len, sizeof(out), tag->title); break;
+            case 'a': append_field(out, &len, sizeof(out), tag->artist); break;
+            case 'A': append_field(out, &len, sizeof(out), tag->album); break;
+            case 'y': append_field(out, &len, sizeof(out), tag->year); break;
+            case 'c': append_field(out, &len, sizeof(out), tag->composer); break;
+            case 'g': append_field(out, &len, sizeof(out), tag->content_type); break;
+            case 'C': append_field(out, &len, sizeof(out), tag->comment); break;
+            case 'T':
+                // "3/12" -> "03"
+                snprintf(track, sizeof(track), "%02d", atoi(tag->track) % 1000);
+                append_field(out, &len, sizeof(out), track);
+                break;
+            default:
+                out[len++] = *p;
+                out[len] = '\0';
+                break;
+        }
+    }
+
+    sanitize_components(out, sizeof(out));
+    if (out[0] == '\0') return NULL;
+
+    // Always produce an .mp3 target
+    if (!mp3_extn(out) && strlen(out) + 5 < sizeof(out))
+        strcat(out, ".mp3");
+
+    return strdup(out);
+}
+
+// Scan callback (runs on worker threads): renders the target for one job
+static void organize_tag(int index, const ID3v2Tag *tag, void *ctx)
+{
+    OrganizeWork *work = (OrganizeWork *)ctx;
+    OrganizeJob *job = &work->jobs[index];
+
+    if (!mp3_extn(job->src))
+    {
+        printf(YELLOW "Skipping %s: not an .mp3 file\n" RESET, job->src);
+        return;
+    }
+    if (!tag)
+    {
+        printf(YELLOW "Skipping %s: no readable tag\n" RESET, job->src);
+        return;
+    }
+
+    job->rel = render_template(work->tpl, tag);
+    if (!job->rel)
+        printf(YELLOW "Skipping %s: template rendered an empty path\n" RESET, job->src);
+}
+
+// Creates every missing directory of rel (relative to dest_fd), consulting the cache first
+static Status ensure_dirs(int dest_fd, const char *rel, PathSet *dirs)
+{
+    char dir[4096];
+    const char *slash = strrchr(rel, '/');
+    if (!slash) return SUCCESS;
+
+    size_t dir_len = (size_t)(slash - rel);
+    if (dir_len >= sizeof(dir)) return FAILURE;
+    memcpy(dir, rel, dir_len);
+    dir[dir_len] = '\0';
+
+    if (pathset_contains(dirs, dir)) return SUCCESS;
+
+    // Walk each prefix so parents are created before children
+    for (size_t i = 1; i <= dir_len; i++)
+    {
+        if (dir[i] != '/' && dir[i] != '\0') continue;
+
+        char saved = dir[i];
+        dir[i] = '\0';
+        if (!pathset_contains(dirs, dir))
+        {
+            if (mkdirat(dest_fd, dir, 0755) != 0 && errno != EEXIST)
+            {
+                printf(RED "Error creating directory %s: %s\n" RESET, dir, strerror(errno));
+                return FAILURE;
+            }
+            if (pathset_add(dirs, dir) < 0) return FAILURE;
+        }
+        dir[i] = saved;
+    }
+    return SUCCESS;
+}
+
+// Builds "name (n).mp3" from "name.mp3"; n == 0 yields the original path
+static void collision_name(char *out, size_t out_size, const char *rel, int n)
+{
+    if (n == 0)
+    {
+        snprintf(out, out_size, "%s", rel);
+        return;
+    }
+    int stem_len = (int)strlen(rel) - 4; // rel always ends in .mp3
+    snprintf(out, out_size, "%.*s (%d)%s", stem_len, rel, n, rel + stem_len);
+}
+
+// Moves src to rel without ever replacing an existing target or copying data
+static int move_noreplace(const char *src, int dest_fd, const char *rel)
+{
+#ifdef SYS_renameat2
+    if (syscall(SYS_renameat2, AT_FDCWD, src, dest_fd, rel, RENAME_NOREPLACE) == 0)
+        return 0;
+    if (errno != ENOSYS && errno != EINVAL)
+        return -1;
+#endif
+    // Fallback: link + unlink also refuses to replace an existing target
+    if (linkat(AT_FDCWD, src, dest_fd, rel, 0) != 0)
+        return -1;
+    return unlink(src);
+}
+
+// Returns 1 if src and rel (in dest_fd) are the same inode
+static int same_file(const char *src, int dest_fd, const char *rel)
+{
+    struct stat a, b;
+    if (stat(src, &a) != 0 || fstatat(dest_fd, rel, &b, 0) != 0) return 0;
+    return a.st_dev == b.st_dev && a.st_ino == b.st_ino;
+}
+
+// Places one file under dest_fd; returns 1 placed, 0 already in place, -1 on error
+static int place_file(const OrganizeJob *job, int dest_fd, const char *dest_dir,
+                      int flags, PathSet *planned)
+{
+    char target[4096 + 16];
+
+    for (int n = 0; n < MAX_COLLISIONS; n++)
+    {
+        collision_name(target, sizeof(target), job->rel, n);
+
+        if (flags & ORGANIZE_DRY_RUN)
+        {
+            if (pathset_contains(planned, target)) continue;
+            if (faccessat(dest_fd, target, F_OK, AT_SYMLINK_NOFOLLOW) == 0)
+            {
+                if (same_file(job->src, dest_fd, target)) return 0;
+                continue;
+            }
+            if (pathset_add(planned, target) < 0) return -1;
+            printf("%s %s -> %s/%s\n", (flags & ORGANIZE_HARDLINK) ? "LINK" : "MOVE",
+                   job->src, dest_dir, target);
+            return 1;
+        }
+
+        int rc = (flags & ORGANIZE_HARDLINK)
+                 ? linkat(AT_FDCWD, job->src, dest_fd, target, 0)
+                 : move_noreplace(job->src, dest_fd, target);
+        if (rc == 0) return 1;
+
+        if (errno != EEXIST)
+        {
+            printf(RED "Error placing %s at %s/%s: %s\n" RESET,
+                   job->src, dest_dir, target, strerror(errno));
+            return -1;
+        }
+        if (same_file(job->src, dest_fd, target)) return 0;
+    }
+
+    printf(RED "Error placing %s: too many name collisions\n" RESET, job->src);
+    return -1;
+}
+
+// Organizes files into dest_dir following tpl, using rename or hardlink only
+Status organize_mp3_files(const char *dest_dir, const char *tpl, char **files, int count, int flags)
+{
+    if (count <= 0) return FAILURE;
+
+    if (!(flags & ORGANIZE_DRY_RUN) && mkdir(dest_dir, 0755) != 0 && errno != EEXIST)
+    {
+        printf(RED "Error creating destination %s: %s\n" RESET, dest_dir, strerror(errno));
+        return FAILURE;
+    }
+
+    // A missing destination is fine for a dry run: nothing exists there yet
+    int dest_fd = open(dest_dir, O_RDONLY | O_DIRECTORY);
+    if (dest_fd < 0 && !((flags & ORGANIZE_DRY_RUN) && errno == ENOENT))
+    {
+        printf(RED "Error opening destination %s: %s\n" RESET, dest_dir, strerror(errno));
+        return FAILURE;
+    }
+
+    OrganizeWork work;
+    work.jobs = calloc(count, sizeof(OrganizeJob));
+    if (!work.jobs) { if (dest_fd >= 0) close(dest_fd); return FAILURE; }
+    work.tpl = tpl;
+    for (int i = 0; i < count; i++)
+        work.jobs[i].src = files[i];
+
+    // Sweep the disk once instead of seeking in argument order (phase 1 only)
+    int *order = NULL;
+    if (flags & ORGANIZE_SCHEDULE)
+    {
+        order = malloc(count * sizeof(int));
+        if (!order || schedule_scan_order(files, count, order) != SUCCESS)
+        {
+            printf(YELLOW "Warning: could not schedule scan, reading in argument order\n" RESET);
+            free(order);
+            order = NULL;
+        }
+    }
+
+    // Phase 1: read tags and render targets in parallel
+    scan_mp3_tags(files, order, count, (flags & ORGANIZE_SCHEDULE) != 0, organize_tag, &work);
+    free(order);
+
+    // Phase 2: create directories and place files sequentially in argument order,
+    // so collision suffixes are reproducible regardless of disk layout
+    PathSet dirs = {0};
+    PathSet planned = {0};
+    int placed = 0, in_place = 0, failed = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        OrganizeJob *job = &work.jobs[i];
+        if (!job->rel) { failed++; continue; }
+
+        if (!(flags & ORGANIZE_DRY_RUN) && ensure_dirs(dest_fd, job->rel, &dirs) != SUCCESS)
+        {
+            failed++;
+            continue;
+        }
+
+        int rc = place_file(job, dest_fd, dest_dir, flags, &planned);
+        if (rc > 0) placed++;
+        else if (rc == 0) in_place++;
+        else failed++;
+    }
+
+    printf("%s%s: %d %s, %d already in place, %d skipped%s\n",
+           failed ? YELLOW : GREEN,
+           (flags & ORGANIZE_DRY_RUN) ? "Plan" : "Organized",
+           placed, (flags & ORGANIZE_HARDLINK) ? "linked" : "moved",
+           in_place, failed, RESET);
+
+    for (int i = 0; i < count; i++)
+        free(work.jobs[i].rel);
+    free(work.jobs);
+    pathset_free(&dirs);
+    pathset_free(&planned);
+    if (dest_fd >= 0) close(dest_fd);
+
+    return failed ? FAILURE : SUCCESS;
+}
\ No newline at end of file
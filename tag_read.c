@@ -80,14 +80,20 @@ Status read_mp3_tag_v2(const char *filename, ID3v2Tag *tag)
         // --- TEXT FRAMES (T***) ---
         if (frame_id[0] == 'T' && strcmp(frame_id, "TXX") != 0)
         {
-            fgetc(fp); // Skip encoding byte
+            int encoding = fgetc(fp);
+            unsigned char raw[1024];
             char buffer[1024] = {0};
             int data_len = frame_size - 1;
+            int keep = data_len < (int)sizeof(raw) ? data_len : (int)sizeof(raw);
             
-            if (data_len > 0)
+            if (keep > 0)
             {
-                if (fread(buffer, 1, data_len, fp) != data_len) break;
+                if (fread(raw, 1, keep, fp) != (size_t)keep) break;
             }
+            if (data_len > keep) fseek(fp, data_len - keep, SEEK_CUR); // Skip oversized text
+
+            // Convert ISO-8859-1 / UTF-16 / UTF-8 text to UTF-8
+            decode_id3_text(encoding, raw, keep, buffer, sizeof(buffer));
 
             if (strcmp(frame_id, "TIT2") == 0) strncpy(tag->title, buffer, sizeof(tag->title) - 1);
             else if (strcmp(frame_id, "TPE1") == 0) strncpy(tag->artist, buffer, sizeof(tag->artist) - 1);
@@ -101,29 +107,28 @@ Status read_mp3_tag_v2(const char *filename, ID3v2Tag *tag)
         // --- COMMENT FRAME (COMM) ---
         else if (strcmp(frame_id, "COMM") == 0)
         {
-            fgetc(fp); // Skip encoding byte
-            fseek(fp, 3, SEEK_CUR); // Skip language code
-            
-            int bytes_skipped = 4;
-            int remaining_frame_size = frame_size - bytes_skipped;
+            // [Encoding (1)] + [Language (3)] + [Description (terminated)] + [Text]
+            unsigned char raw[1024];
+            int keep = frame_size < (int)sizeof(raw) ? frame_size : (int)sizeof(raw);
+            if (fread(raw, 1, keep, fp) != (size_t)keep) break;
+            if (frame_size > keep) fseek(fp, frame_size - keep, SEEK_CUR);
+
+            int encoding = raw[0];
+            int wide = (encoding == 1 || encoding == 2); // UTF-16 ends with 00 00
+            int text = 4;
             
-            // Skip Short Content Description (null-terminated)
-            char description_byte;
-            int desc_len = 0;
-            
-            while (desc_len < remaining_frame_size && (description_byte = fgetc(fp)) != '\0')
+            // Skip Short Content Description
+            while (text < keep)
             {
-                desc_len++;
+                if (!wide && raw[text] == 0) { text += 1; break; }
+                if (wide && text + 1 < keep && raw[text] == 0 && raw[text + 1] == 0) { text += 2; break; }
+                text += wide ? 2 : 1;
             }
             
-            int total_skipped = bytes_skipped + desc_len + 1; 
-            remaining_frame_size = frame_size - total_skipped;
-            
             // Read the Actual Comment Text
-            if (remaining_frame_size > 0)
+            if (text < keep)
             {
-                if (fread(tag->comment, 1, remaining_frame_size, fp) != remaining_frame_size) break;
-                tag->comment[remaining_frame_size] = '\0';
+                decode_id3_text(encoding, &raw[text], keep - text, tag->comment, sizeof(tag->comment));
             }
         }
         // ATTACHED PICTURE FRAME (APIC)
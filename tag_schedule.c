@@ -0,0 +1,329 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#include <linux/fiemap.h>
+#endif
+#include "tag.h"
+#include "colour.h"
+
+#define HINT_LOOKAHEAD 32  // Files hinted ahead of the readers in a scheduled scan
+#define MAX_SCAN_THREADS 64
+
+// Sort key for one file: device first, then physical offset (or inode)
+typedef struct
+{
+    int index;
+    unsigned long long dev;
+    unsigned long long physical;
+    unsigned long long ino;
+    int has_physical;
+} ScanEntry;
+
+// Shared state for the parallel tag scan
+typedef struct
+{
+    char **files;
+    const int *order;       // Visit order (NULL = argument order)
+    int count;
+    int hinted;
+    TagScanCallback on_tag;
+    void *ctx;
+    atomic_int next;        // Next position to read
+    atomic_int hint_next;   // Next position to hint, kept HINT_LOOKAHEAD ahead of next
+} ScanWork;
+
+static int use_physical_keys;
+
+// Physical byte offset of the first block of fd, via FIEMAP then FIBMAP
+static int first_physical_offset(int fd, unsigned long long *offset)
+{
+#ifdef __linux__
+    struct
+    {
+        struct fiemap map;
+        struct fiemap_extent extent;
+    } req;
+
+    memset(&req, 0, sizeof(req));
+    req.map.fm_start = 0;
+    req.map.fm_length = ~0ULL;
+    req.map.fm_extent_count = 1;
+
+    if (ioctl(fd, FS_IOC_FIEMAP, &req.map) == 0 && req.map.fm_mapped_extents > 0 &&
+        !(req.extent.fe_flags & FIEMAP_EXTENT_UNKNOWN))
+    {
+        *offset = req.extent.fe_physical;
+        return 1;
+    }
+
+    // FIBMAP needs CAP_SYS_RAWIO; block 0 maps to the tag header
+    int block = 0;
+    int blksize = 0;
+    if (ioctl(fd, FIBMAP, &block) == 0 && block > 0 && ioctl(fd, FIGETBSZ, &blksize) == 0)
+    {
+        *offset = (unsigned long long)block * (unsigned long long)blksize;
+        return 1;
+    }
+#else
+    (void)fd;
+    (void)offset;
+#endif
+    return 0;
+}
+
+static int compare_scan_entries(const void *a, const void *b)
+{
+    const ScanEntry *x = (const ScanEntry *)a;
+    const ScanEntry *y = (const ScanEntry *)b;
+
+    if (x->dev != y->dev) return x->dev < y->dev ? -1 : 1;
+
+    unsigned long long kx = use_physical_keys ? x->physical : x->ino;
+    unsigned long long ky = use_physical_keys ? y->physical : y->ino;
+    if (kx != ky) return kx < ky ? -1 : 1;
+    return x->index - y->index;
+}
+
+// Fills order with the indexes of files sorted by on-disk position, so a
+// cold-cache scan sweeps the platter once; files itself is left untouched
+Status schedule_scan_order(char **files, int count, int *order)
+{
+    for (int i = 0; i < count; i++)
+        order[i] = i;
+    if (count <= 1) return SUCCESS;
+
+    ScanEntry *entries = calloc(count, sizeof(ScanEntry));
+    if (!entries) return FAILURE;
+
+    int all_physical = 1;
+    for (int i = 0; i < count; i++)
+    {
+        ScanEntry *e = &entries[i];
+        e->index = i;
+
+        int fd = open(files[i], O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0)
+        {
+            // Unreadable files sort last; the reader reports the error later
+            e->dev = ~0ULL;
+            e->ino = ~0ULL;
+            e->physical = ~0ULL;
+            e->has_physical = 1;
+            if (fd >= 0) close(fd);
+            continue;
+        }
+
+        e->dev = (unsigned long long)st.st_dev;
+        e->ino = (unsigned long long)st.st_ino;
+        e->has_physical = first_physical_offset(fd, &e->physical);
+        if (!e->has_physical) all_physical = 0;
+        close(fd);
+    }
+
+    // Mixing physical offsets with inode numbers is meaningless, so pick one key for all
+    use_physical_keys = all_physical;
+    qsort(entries, count, sizeof(ScanEntry), compare_scan_entries);
+
+    for (int i = 0; i < count; i++)
+        order[i] = entries[i].index;
+
+    free(entries);
+    return SUCCESS;
+}
+
+// Prefetches only the bytes the tag readers will touch, never the audio payload
+void advise_tag_readahead(const char *filename)
+{
+#ifdef POSIX_FADV_WILLNEED
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return;
+
+    // Disable kernel readahead on this fd so reading the header pulls in one page only
+    posix_fadvise(fd, 0, 0, POSIX_FADV_RANDOM);
+
+    unsigned char header[10];
+    if (pread(fd, header, 10, 0) == 10 && strncmp((char *)header, "ID3", 3) == 0)
+    {
+        // 10 + tag_size, plus one stdio buffer because fread refills past the tag end
+        off_t len = 10 + read_synchsafe_int(&header[6]);
+        if (header[5] & 0x10) len += 10; // Footer present
+        posix_fadvise(fd, 0, len + BUFSIZ, POSIX_FADV_WILLNEED);
+    }
+    else
+    {
+        // No ID3v2 header: the reader falls back to the 128-byte v1 trailer
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size >= 128)
+            posix_fadvise(fd, st.st_size - 128, 128, POSIX_FADV_WILLNEED);
+    }
+
+    close(fd);
+#else
+    (void)filename;
+#endif
+}
+
+// Evicts the files from the cache; returns the method used
+static const char *drop_file_caches(char **files, int count)
+{
+    sync();
+    int fd = open("/proc/sys/vm/drop_caches", O_WRONLY);
+    if (fd >= 0)
+    {
+        // "3": page cache plus dentries and inodes, so neither run inherits warm metadata
+        int ok = write(fd, "3", 1) == 1;
+        close(fd);
+        if (ok) return "drop_caches (pages, dentries, inodes)";
+    }
+
+#ifdef POSIX_FADV_DONTNEED
+    // Unprivileged fallback: evict each file's clean pages individually
+    for (int i = 0; i < count; i++)
+    {
+        int ffd = open(files[i], O_RDONLY);
+        if (ffd < 0) continue;
+        posix_fadvise(ffd, 0, 0, POSIX_FADV_DONTNEED);
+        close(ffd);
+    }
+    return "fadvise(DONTNEED) - data only, dentries/inodes stay warm after the first run";
+#else
+    (void)files;
+    (void)count;
+    return "none (results may be warm-cache)";
+#endif
+}
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Advances the shared hint cursor up to HINT_LOOKAHEAD positions past pos
+static void issue_hints(ScanWork *work, int pos)
+{
+    int limit = pos + HINT_LOOKAHEAD < work->count ? pos + HINT_LOOKAHEAD : work->count;
+    int h = atomic_load(&work->hint_next);
+
+    while (h < limit)
+    {
+        // Each position is claimed by exactly one thread
+        if (atomic_compare_exchange_weak(&work->hint_next, &h, h + 1))
+        {
+            advise_tag_readahead(work->files[work->order ? work->order[h] : h]);
+            h++;
+        }
+    }
+}
+
+// Worker: reads tags for positions claimed from the shared counter
+static void *scan_worker(void *arg)
+{
+    ScanWork *work = (ScanWork *)arg;
+    int pos;
+
+    while ((pos = atomic_fetch_add(&work->next, 1)) < work->count)
+    {
+        if (work->hinted)
+            issue_hints(work, pos);
+
+        int index = work->order ? work->order[pos] : pos;
+        ID3v2Tag tag = {0};
+
+        if (mp3_extn(work->files[index]) && read_mp3_tag(work->files[index], &tag) == SUCCESS)
+            work->on_tag(index, &tag, work->ctx);
+        else
+            work->on_tag(index, NULL, work->ctx);
+    }
+    return NULL;
+}
+
+// Reads the tags of files in parallel, visiting them in order (NULL = argument order)
+// and, if hinted, prefetching each tag HINT_LOOKAHEAD files before it is read.
+// on_tag gets the file's argument index and its tag (NULL if unreadable or not .mp3).
+Status scan_mp3_tags(char **files, const int *order, int count, int hinted,
+                     TagScanCallback on_tag, void *ctx)
+{
+    ScanWork work;
+    work.files = files;
+    work.order = order;
+    work.count = count;
+    work.hinted = hinted;
+    work.on_tag = on_tag;
+    work.ctx = ctx;
+    atomic_init(&work.next, 0);
+    atomic_init(&work.hint_next, 0);
+
+    long nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (nthreads < 1) nthreads = 1;
+    if (nthreads > MAX_SCAN_THREADS) nthreads = MAX_SCAN_THREADS;
+    if (nthreads > count) nthreads = count;
+
+    pthread_t threads[MAX_SCAN_THREADS];
+    int started = 0;
+    for (long t = 0; t < nthreads; t++)
+    {
+        if (pthread_create(&threads[t], NULL, scan_worker, &work) != 0) break;
+        started++;
+    }
+    if (started == 0) scan_worker(&work);
+    for (int t = 0; t < started; t++)
+        pthread_join(threads[t], NULL);
+
+    return SUCCESS;
+}
+
+// Benchmark callback: counts files with a readable tag
+static void count_tag(int index, const ID3v2Tag *tag, void *ctx)
+{
+    (void)index;
+    if (tag) atomic_fetch_add((atomic_int *)ctx, 1);
+}
+
+// Compares cold-cache scan throughput in the given order vs the scheduled order,
+// using the same threaded scan as organize mode (-o vs -o --schedule)
+Status benchmark_scan(char **files, int count)
+{
+    if (count <= 0) return FAILURE;
+
+    int *order = malloc(count * sizeof(int));
+    if (!order) return FAILURE;
+
+    atomic_int found_plain, found_sched;
+    atomic_init(&found_plain, 0);
+    atomic_init(&found_sched, 0);
+
+    const char *method = drop_file_caches(files, count);
+    double start = now_seconds();
+    scan_mp3_tags(files, NULL, count, 0, count_tag, &found_plain);
+    double plain = now_seconds() - start;
+
+    drop_file_caches(files, count);
+    start = now_seconds();
+    int *sched_order = schedule_scan_order(files, count, order) == SUCCESS ? order : NULL;
+    scan_mp3_tags(files, sched_order, count, 1, count_tag, &found_sched);
+    double sched = now_seconds() - start;
+
+    printf("\n%s%s==================== SCAN BENCHMARK (%d files) ====================%s\n", BOLD, BLUE, count, RESET);
+    printf("Cache eviction : %s\n", method);
+    printf("Sort key       : %s\n", use_physical_keys ? "physical offset (FIEMAP/FIBMAP)" : "inode number");
+    printf("Given order    : %8.3f s  %10.1f files/s  (%d tags)\n", plain, count / (plain > 0 ? plain : 1e-9), atomic_load(&found_plain));
+    printf("Scheduled      : %8.3f s  %10.1f files/s  (%d tags)\n", sched, count / (sched > 0 ? sched : 1e-9), atomic_load(&found_sched));
+    printf("%sSpeedup        : %.2fx%s\n\n", GREEN, sched > 0 ? plain / sched : 0.0, RESET);
+
+    free(order);
+    return SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,719 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include "tag.h"
+#include "colour.h"
+
+// Archive record: fixed header, path, ID3v2 bytes, ID3v1 trailer, record trailer
+// "TSNP" | path_len | v2_len | v1_len | crc32 | size (8) | mtime_sec (8) | mtime_nsec
+// ... | record crc32 (everything before it) | record length
+#define SNAPSHOT_MAGIC       "TSNP"
+#define SNAPSHOT_HEADER_LEN  40
+#define SNAPSHOT_TRAILER_LEN 8
+#define CRC_CHUNK           (256 * 1024)
+
+// One file's tag-only snapshot
+typedef struct
+{
+    char path[PATH_MAX];
+    unsigned int v2_len;
+    unsigned int v1_len;
+    unsigned int crc;
+    unsigned long long size;
+    unsigned long long mtime_sec;
+    unsigned int mtime_nsec;
+    unsigned char *v2;
+    unsigned char v1[128];
+} TagSnapshot;
+
+// Index entry used to pick one record per file during rollback
+typedef struct
+{
+    char *path;
+    long offset;
+} SnapshotIndex;
+
+static void put_u32(unsigned char *p, unsigned int v)
+{
+    p[0] = (v >> 24) & 0xFF;
+    p[1] = (v >> 16) & 0xFF;
+    p[2] = (v >> 8) & 0xFF;
+    p[3] = v & 0xFF;
+}
+
+static unsigned int get_u32(const unsigned char *p)
+{
+    return ((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) | ((unsigned int)p[2] << 8) | p[3];
+}
+
+static void put_u64(unsigned char *p, unsigned long long v)
+{
+    put_u32(p, (unsigned int)(v >> 32));
+    put_u32(p + 4, (unsigned int)v);
+}
+
+static unsigned long long get_u64(const unsigned char *p)
+{
+    return ((unsigned long long)get_u32(p) << 32) | get_u32(p + 4);
+}
+
+// Standard CRC-32 (IEEE 802.3), table built on first use
+static unsigned int crc32_update(unsigned int crc, const unsigned char *data, size_t len)
+{
+    static unsigned int table[256];
+    static int table_ready = 0;
+
+    if (!table_ready)
+    {
+        for (unsigned int i = 0; i < 256; i++)
+        {
+            unsigned int c = i;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        table_ready = 1;
+    }
+
+    crc = ~crc;
+    while (len--)
+        crc = table[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+// Finds the ID3v2 tag length at the start and the ID3v1 trailer length at the end
+static Status locate_tag_regions(int fd, off_t size, unsigned int *v2_len, unsigned int *v1_len)
+{
+    unsigned char header[10];
+    *v2_len = 0;
+    *v1_len = 0;
+
+    if (size >= 10 && pread(fd, header, 10, 0) == 10 && strncmp((char *)header, "ID3", 3) == 0)
+    {
+        off_t len = 10 + read_synchsafe_int(&header[6]);
+        if (header[5] & 0x10) len += 10; // Footer present
+        if (len > size) return FAILURE;
+        *v2_len = (unsigned int)len;
+    }
+
+    unsigned char trailer[3];
+    if (size - *v2_len >= 128 && pread(fd, trailer, 3, size - 128) == 3 && strncmp((char *)trailer, "TAG", 3) == 0)
+        *v1_len = 128;
+
+    return SUCCESS;
+}
+
+// CRC-32 of the audio payload between the two tags
+static Status payload_crc(int fd, off_t start, off_t end, unsigned int *crc)
+{
+    unsigned char *buf = malloc(CRC_CHUNK);
+    if (!buf) return FAILURE;
+
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, start, end - start, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    *crc = 0;
+    while (start < end)
+    {
+        size_t want = (end - start) < CRC_CHUNK ? (size_t)(end - start) : CRC_CHUNK;
+        ssize_t got = pread(fd, buf, want, start);
+        if (got <= 0) { free(buf); return FAILURE; }
+        *crc = crc32_update(*crc, buf, (size_t)got);
+        start += got;
+    }
+
+    free(buf);
+    return SUCCESS;
+}
+
+// Captures the tag bytes, stat signature and payload checksum of one file
+static Status capture_snapshot(const char *filename, TagSnapshot *snap)
+{
+    if (!realpath(filename, snap->path))
+    {
+        printf(RED "Error resolving %s: %s\n" RESET, filename, strerror(errno));
+        return FAILURE;
+    }
+
+    int fd = open(snap->path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        printf(RED "Error opening %s: %s\n" RESET, filename, strerror(errno));
+        if (fd >= 0) close(fd);
+        return FAILURE;
+    }
+
+    snap->size = (unsigned long long)st.st_size;
+    snap->mtime_sec = (unsigned long long)st.st_mtim.tv_sec;
+    snap->mtime_nsec = (unsigned int)st.st_mtim.tv_nsec;
+    snap->v2 = NULL;
+
+    if (locate_tag_regions(fd, st.st_size, &snap->v2_len, &snap->v1_len) != SUCCESS)
+    {
+        printf(RED "Error: %s has a corrupt ID3v2 header\n" RESET, filename);
+        close(fd);
+        return FAILURE;
+    }
+
+    Status status = SUCCESS;
+    if (snap->v2_len)
+    {
+        snap->v2 = malloc(snap->v2_len);
+        if (!snap->v2 || pread(fd, snap->v2, snap->v2_len, 0) != (ssize_t)snap->v2_len)
+            status = FAILURE;
+    }
+    if (status == SUCCESS && snap->v1_len &&
+        pread(fd, snap->v1, 128, st.st_size - 128) != 128)
+        status = FAILURE;
+    if (status == SUCCESS)
+        status = payload_crc(fd, snap->v2_len, st.st_size - snap->v1_len, &snap->crc);
+
+    close(fd);
+    if (status != SUCCESS)
+    {
+        printf(RED "Error reading %s\n" RESET, filename);
+        free(snap->v2);
+        snap->v2 = NULL;
+    }
+    return status;
+}
+
+// Total on-disk length of a record
+static long record_length(const TagSnapshot *snap)
+{
+    return SNAPSHOT_HEADER_LEN + (long)strlen(snap->path) + snap->v2_len + snap->v1_len + SNAPSHOT_TRAILER_LEN;
+}
+
+// Appends one record, sealed with its own CRC so torn or corrupt records are detectable.
+// The record goes out in one write() on the O_APPEND descriptor, never split by stdio.
+static Status append_snapshot(int fd, const TagSnapshot *snap)
+{
+    unsigned int path_len = (unsigned int)strlen(snap->path);
+    size_t rec_len = (size_t)record_length(snap);
+    unsigned char *rec = malloc(rec_len);
+    if (!rec) return FAILURE;
+
+    memcpy(rec, SNAPSHOT_MAGIC, 4);
+    put_u32(rec + 4, path_len);
+    put_u32(rec + 8, snap->v2_len);
+    put_u32(rec + 12, snap->v1_len);
+    put_u32(rec + 16, snap->crc);
+    put_u64(rec + 20, snap->size);
+    put_u64(rec + 28, snap->mtime_sec);
+    put_u32(rec + 36, snap->mtime_nsec);
+
+    unsigned char *p = rec + SNAPSHOT_HEADER_LEN;
+    memcpy(p, snap->path, path_len);
+    p += path_len;
+    if (snap->v2_len) memcpy(p, snap->v2, snap->v2_len);
+    p += snap->v2_len;
+    if (snap->v1_len) memcpy(p, snap->v1, snap->v1_len);
+    p += snap->v1_len;
+
+    put_u32(p, crc32_update(0, rec, rec_len - SNAPSHOT_TRAILER_LEN));
+    put_u32(p + 4, (unsigned int)rec_len);
+
+    Status status = write(fd, rec, rec_len) == (ssize_t)rec_len ? SUCCESS : FAILURE;
+    free(rec);
+    return status;
+}
+
+// Reads and checks the record at offset; snap->v2 is malloc'd.
+// Fails on torn or corrupt records (lengths past the end, bad record CRC).
+static Status read_snapshot(FILE *in, long offset, long archive_size, TagSnapshot *snap)
+{
+    unsigned char header[SNAPSHOT_HEADER_LEN];
+    snap->v2 = NULL;
+
+    if (archive_size - offset < SNAPSHOT_HEADER_LEN + SNAPSHOT_TRAILER_LEN ||
+        fseek(in, offset, SEEK_SET) != 0 ||
+        fread(header, 1, SNAPSHOT_HEADER_LEN, in) != SNAPSHOT_HEADER_LEN ||
+        memcmp(header, SNAPSHOT_MAGIC, 4) != 0)
+        return FAILURE;
+
+    unsigned long long path_len = get_u32(header + 4);
+    unsigned long long v2_len = get_u32(header + 8);
+    unsigned long long v1_len = get_u32(header + 12);
+    unsigned long long rec_len = SNAPSHOT_HEADER_LEN + path_len + v2_len + v1_len + SNAPSHOT_TRAILER_LEN;
+
+    if (path_len >= sizeof(snap->path) || (v1_len != 0 && v1_len != 128) ||
+        rec_len > (unsigned long long)(archive_size - offset))
+        return FAILURE;
+
+    unsigned char *rec = malloc(rec_len);
+    if (!rec) return FAILURE;
+    memcpy(rec, header, SNAPSHOT_HEADER_LEN);
+
+    size_t rest = rec_len - SNAPSHOT_HEADER_LEN;
+    const unsigned char *trailer = rec + rec_len - SNAPSHOT_TRAILER_LEN;
+    if (fread(rec + SNAPSHOT_HEADER_LEN, 1, rest, in) != rest ||
+        crc32_update(0, rec, rec_len - SNAPSHOT_TRAILER_LEN) != get_u32(trailer) ||
+        get_u32(trailer + 4) != rec_len)
+    {
+        free(rec);
+        return FAILURE;
+    }
+
+    snap->v2_len = (unsigned int)v2_len;
+    snap->v1_len = (unsigned int)v1_len;
+    snap->crc = get_u32(header + 16);
+    snap->size = get_u64(header + 20);
+    snap->mtime_sec = get_u64(header + 28);
+    snap->mtime_nsec = get_u32(header + 36);
+
+    const unsigned char *p = rec + SNAPSHOT_HEADER_LEN;
+    memcpy(snap->path, p, path_len);
+    snap->path[path_len] = '\0';
+    p += path_len;
+
+    Status status = (v2_len + v1_len <= snap->size) ? SUCCESS : FAILURE;
+    if (status == SUCCESS && v2_len)
+    {
+        snap->v2 = malloc(v2_len);
+        if (snap->v2) memcpy(snap->v2, p, v2_len);
+        else status = FAILURE;
+    }
+    if (status == SUCCESS && v1_len) memcpy(snap->v1, p + v2_len, 128);
+
+    free(rec);
+    return status;
+}
+
+// Offset of the next record magic at or after offset, or archive_size if none
+static long find_magic(FILE *in, long offset, long archive_size)
+{
+    const char *magic = SNAPSHOT_MAGIC;
+    int matched = 0;
+    int c;
+
+    if (fseek(in, offset, SEEK_SET) != 0) return archive_size;
+    while (offset < archive_size && (c = fgetc(in)) != EOF)
+    {
+        offset++;
+        if (c == magic[matched]) matched++;
+        else matched = (c == magic[0]) ? 1 : 0;
+        if (matched == 4) return offset - 4;
+    }
+    return archive_size;
+}
+
+// Reports a damaged region, naming the file if the record header still holds its path
+static void report_damage(FILE *in, long offset, long archive_size, const char *archive)
+{
+    unsigned char header[SNAPSHOT_HEADER_LEN];
+    char path[PATH_MAX];
+    unsigned int path_len = 0;
+
+    if (archive_size - offset >= SNAPSHOT_HEADER_LEN &&
+        fseek(in, offset, SEEK_SET) == 0 &&
+        fread(header, 1, SNAPSHOT_HEADER_LEN, in) == SNAPSHOT_HEADER_LEN &&
+        memcmp(header, SNAPSHOT_MAGIC, 4) == 0)
+        path_len = get_u32(header + 4);
+
+    if (path_len > 0 && path_len < sizeof(path) &&
+        path_len <= (unsigned long)(archive_size - offset - SNAPSHOT_HEADER_LEN) &&
+        fread(path, 1, path_len, in) == path_len && path[0] == '/' && !memchr(path, '\0', path_len))
+    {
+        path[path_len] = '\0';
+        printf(RED "Error: damaged snapshot record for %s at offset %ld in %s\n" RESET, path, offset, archive);
+    }
+    else
+        printf(RED "Error: damaged data at offset %ld in %s\n" RESET, offset, archive);
+}
+
+// Finds the next valid record at or after *offset, resynchronising past damaged
+// bytes; returns 1 with *offset at its start, 0 at the end of the archive.
+// Each damaged region is counted, and reported if archive is given.
+static int next_snapshot(FILE *in, long *offset, long archive_size, TagSnapshot *snap,
+                         int *damaged, const char *archive)
+{
+    long pos = *offset;
+    int skipped = 0;
+
+    while (pos < archive_size)
+    {
+        if (read_snapshot(in, pos, archive_size, snap) == SUCCESS)
+        {
+            *offset = pos;
+            return 1;
+        }
+        if (!skipped)
+        {
+            (*damaged)++;
+            if (archive) report_damage(in, pos, archive_size, archive);
+        }
+        skipped = 1;
+        pos = find_magic(in, pos + 1, archive_size);
+    }
+
+    *offset = archive_size;
+    return 0;
+}
+
+// End of the last valid record; anything after it is a torn append
+static long valid_archive_end(FILE *in, long archive_size)
+{
+    TagSnapshot snap;
+    unsigned char trailer[SNAPSHOT_TRAILER_LEN];
+
+    if (archive_size == 0) return 0;
+
+    // Fast path: the final record is intact
+    if (archive_size >= SNAPSHOT_TRAILER_LEN &&
+        fseek(in, archive_size - SNAPSHOT_TRAILER_LEN, SEEK_SET) == 0 &&
+        fread(trailer, 1, SNAPSHOT_TRAILER_LEN, in) == SNAPSHOT_TRAILER_LEN)
+    {
+        long rec_len = (long)get_u32(trailer + 4);
+        if (rec_len <= archive_size &&
+            read_snapshot(in, archive_size - rec_len, archive_size, &snap) == SUCCESS)
+        {
+            free(snap.v2);
+            return archive_size;
+        }
+    }
+
+    // Slow path: walk every record
+    long pos = 0, end = 0;
+    int damaged = 0;
+    while (next_snapshot(in, &pos, archive_size, &snap, &damaged, NULL))
+    {
+        pos += record_length(&snap);
+        end = pos;
+        free(snap.v2);
+    }
+    return end;
+}
+
+// Records the original tags of files into the append-only archive
+Status snapshot_mp3_tags(const char *archive, char **files, int count)
+{
+    FILE *out = fopen(archive, "a+b");
+    if (!out)
+    {
+        perror(RED "Error opening snapshot archive" RESET);
+        return FAILURE;
+    }
+
+    // Held until fclose, so another process can neither append nor truncate
+    // between our tail check and our last record
+    if (flock(fileno(out), LOCK_EX) != 0)
+    {
+        perror(RED "Error locking snapshot archive" RESET);
+        fclose(out);
+        return FAILURE;
+    }
+
+    // Cut off a torn tail left by an interrupted snapshot before appending
+    fseek(out, 0, SEEK_END);
+    long archive_size = ftell(out);
+    long end = valid_archive_end(out, archive_size);
+    if (end < archive_size)
+    {
+        printf(YELLOW "Warning: discarding %ld bytes of damaged data at the end of %s\n" RESET,
+               archive_size - end, archive);
+        if (ftruncate(fileno(out), end) != 0)
+        {
+            perror(RED "Error truncating snapshot archive" RESET);
+            fclose(out);
+            return FAILURE;
+        }
+    }
+
+    int saved = 0, failed = 0;
+    unsigned long long bytes = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        TagSnapshot snap;
+        if (capture_snapshot(files[i], &snap) != SUCCESS)
+        {
+            failed++;
+            continue;
+        }
+
+        if (append_snapshot(fileno(out), &snap) == SUCCESS)
+        {
+            saved++;
+            bytes += record_length(&snap);
+        }
+        else
+        {
+            printf(RED "Error writing snapshot for %s\n" RESET, files[i]);
+            failed++;
+        }
+        free(snap.v2);
+    }
+
+    // The snapshot must be on disk before any edit touches the files
+    if (fsync(fileno(out)) != 0)
+    {
+        perror(RED "Error flushing snapshot archive" RESET);
+        failed++;
+    }
+    fclose(out);
+
+    if (count > 1 || failed)
+    {
+        printf("%sSnapshot: %d files, %llu bytes archived, %d failed%s\n",
+               failed ? YELLOW : GREEN, saved, bytes, failed, RESET);
+    }
+    return failed ? FAILURE : SUCCESS;
+}
+
+// Puts back the recorded mtime so the stat signature matches the snapshot again
+static void restore_mtime(const TagSnapshot *snap)
+{
+    struct timespec times[2];
+    times[0].tv_sec = 0;
+    times[0].tv_nsec = UTIME_OMIT;
+    times[1].tv_sec = (time_t)snap->mtime_sec;
+    times[1].tv_nsec = (long)snap->mtime_nsec;
+    utimensat(AT_FDCWD, snap->path, times, 0);
+}
+
+// Compares the file's current ID3v2 and ID3v1 bytes with the snapshot
+static int tag_bytes_match(int fd, const TagSnapshot *snap, off_t size)
+{
+    int match = 1;
+
+    if (snap->v2_len)
+    {
+        unsigned char *cur = malloc(snap->v2_len);
+        match = cur && pread(fd, cur, snap->v2_len, 0) == (ssize_t)snap->v2_len &&
+                memcmp(cur, snap->v2, snap->v2_len) == 0;
+        free(cur);
+    }
+    if (match && snap->v1_len)
+    {
+        unsigned char cur[128];
+        match = pread(fd, cur, 128, size - 128) == 128 && memcmp(cur, snap->v1, 128) == 0;
+    }
+    return match;
+}
+
+// Restores one file; returns 2 rewritten, 1 restored in place, 0 unchanged, -1 on error
+static int restore_snapshot(const TagSnapshot *snap, int flags)
+{
+    int fd = open(snap->path, O_RDWR);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        printf(RED "Error opening %s: %s\n" RESET, snap->path, strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+
+    unsigned int cur_v2, cur_v1;
+    off_t payload_len = (off_t)(snap->size - snap->v2_len - snap->v1_len);
+    if (locate_tag_regions(fd, st.st_size, &cur_v2, &cur_v1) != SUCCESS ||
+        st.st_size - cur_v2 - cur_v1 != payload_len)
+    {
+        printf(RED "Error: audio payload of %s no longer matches the snapshot\n" RESET, snap->path);
+        close(fd);
+        return -1;
+    }
+
+    // Tag bytes already identical to the snapshot: nothing to restore
+    if (cur_v2 == snap->v2_len && cur_v1 == snap->v1_len && tag_bytes_match(fd, snap, st.st_size))
+    {
+        close(fd);
+        return 0;
+    }
+
+    // The stat signature is only a hint: if it is unchanged the audio was not
+    // rewritten, so the payload checksum can be skipped
+    int same_stat = (unsigned long long)st.st_size == snap->size &&
+                    (unsigned long long)st.st_mtim.tv_sec == snap->mtime_sec &&
+                    (unsigned int)st.st_mtim.tv_nsec == snap->mtime_nsec;
+    int verify = !(flags & ROLLBACK_NO_VERIFY) && !same_stat;
+
+    // Same ID3v2 length: overwrite the tag bytes in place, audio stays untouched
+    if (cur_v2 == snap->v2_len)
+    {
+        off_t payload_end = cur_v2 + payload_len;
+        unsigned int crc;
+
+        if (verify && (payload_crc(fd, cur_v2, payload_end, &crc) != SUCCESS || crc != snap->crc))
+        {
+            printf(RED "Error: audio checksum of %s no longer matches the snapshot\n" RESET, snap->path);
+            close(fd);
+            return -1;
+        }
+        int ok = 1;
+
+        if (snap->v2_len && pwrite(fd, snap->v2, snap->v2_len, 0) != (ssize_t)snap->v2_len) ok = 0;
+        if (ok && snap->v1_len && pwrite(fd, snap->v1, 128, payload_end) != 128) ok = 0;
+        if (ok && !snap->v1_len && cur_v1 && ftruncate(fd, payload_end) != 0) ok = 0;
+        close(fd);
+
+        if (!ok)
+        {
+            printf(RED "Error writing %s: %s\n" RESET, snap->path, strerror(errno));
+            return -1;
+        }
+        restore_mtime(snap);
+        return 1;
+    }
+
+    // Different tag length: rebuild the file through the normal rewrite path,
+    // checking the payload as it sits in the buffer so it is read only once
+    unsigned char *buffer = malloc(snap->size);
+    if (!buffer) { close(fd); return -1; }
+
+    if (snap->v2_len) memcpy(buffer, snap->v2, snap->v2_len);
+    if (pread(fd, buffer + snap->v2_len, payload_len, cur_v2) != payload_len)
+    {
+        printf(RED "Error reading %s\n" RESET, snap->path);
+        free(buffer);
+        close(fd);
+        return -1;
+    }
+    close(fd);
+
+    if (verify && crc32_update(0, buffer + snap->v2_len, (size_t)payload_len) != snap->crc)
+    {
+        printf(RED "Error: audio checksum of %s no longer matches the snapshot\n" RESET, snap->path);
+        free(buffer);
+        return -1;
+    }
+    if (snap->v1_len) memcpy(buffer + snap->v2_len + payload_len, snap->v1, 128);
+
+    Status status = replace_file_contents(snap->path, buffer, (long)snap->size);
+    free(buffer);
+    if (status != SUCCESS) return -1;
+
+    restore_mtime(snap);
+    return 2;
+}
+
+static int compare_index(const void *a, const void *b)
+{
+    const SnapshotIndex *x = (const SnapshotIndex *)a;
+    const SnapshotIndex *y = (const SnapshotIndex *)b;
+    int c = strcmp(x->path, y->path);
+    if (c != 0) return c;
+    return (x->offset > y->offset) - (x->offset < y->offset);
+}
+
+static int compare_paths(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// Restores files (all archived files if count is 0) from the snapshot archive
+Status rollback_mp3_tags(const char *archive, char **files, int count, int flags)
+{
+    FILE *in = fopen(archive, "rb");
+    if (!in)
+    {
+        perror(RED "Error opening snapshot archive" RESET);
+        return FAILURE;
+    }
+
+    // Shared lock: a snapshot still appending would otherwise look like a torn tail
+    if (flock(fileno(in), LOCK_SH) != 0)
+    {
+        perror(RED "Error locking snapshot archive" RESET);
+        fclose(in);
+        return FAILURE;
+    }
+
+    fseek(in, 0, SEEK_END);
+    long archive_size = ftell(in);
+
+    // Pass 1: index every valid record by path, skipping torn or corrupt ones
+    SnapshotIndex *index = NULL;
+    int n = 0, cap = 0, damaged = 0;
+    long pos = 0;
+    TagSnapshot snap;
+    while (next_snapshot(in, &pos, archive_size, &snap, &damaged, archive))
+    {
+        long rec_len = record_length(&snap);
+        free(snap.v2);
+
+        if (n == cap)
+        {
+            cap = cap ? cap * 2 : 1024;
+            SnapshotIndex *grown = realloc(index, cap * sizeof(SnapshotIndex));
+            if (!grown) break;
+            index = grown;
+        }
+        index[n].path = strdup(snap.path);
+        if (!index[n].path) break;
+        index[n].offset = pos;
+        n++;
+        pos += rec_len;
+    }
+    qsort(index, n, sizeof(SnapshotIndex), compare_index);
+
+    // Only the requested files, if any were named
+    char **wanted = NULL;
+    int wanted_count = 0;
+    if (count > 0)
+    {
+        wanted = calloc(count, sizeof(char *));
+        for (int i = 0; wanted && i < count; i++)
+        {
+            char *resolved = realpath(files[i], NULL);
+            if (resolved) wanted[wanted_count++] = resolved;
+            else printf(RED "Error resolving %s: %s\n" RESET, files[i], strerror(errno));
+        }
+        if (wanted) qsort(wanted, wanted_count, sizeof(char *), compare_paths);
+    }
+
+    // Pass 2: restore the newest (or oldest) record of each file, in path order.
+    // A damaged region may have held some file's only snapshot, so it counts as a failure.
+    int in_place = 0, rewritten = 0, unchanged = 0, failed = count - wanted_count + damaged;
+    int matched = 0;
+    for (int i = 0; i < n; )
+    {
+        int j = i;
+        while (j + 1 < n && strcmp(index[j + 1].path, index[i].path) == 0) j++;
+        const SnapshotIndex *pick = (flags & ROLLBACK_OLDEST) ? &index[i] : &index[j];
+        i = j + 1;
+
+        if (count > 0 && !(wanted && bsearch(&pick->path, wanted, wanted_count, sizeof(char *), compare_paths)))
+            continue;
+        matched++;
+
+        if (read_snapshot(in, pick->offset, archive_size, &snap) != SUCCESS)
+        {
+            printf(RED "Error reading snapshot for %s\n" RESET, pick->path);
+            failed++;
+            continue;
+        }
+
+        int rc = restore_snapshot(&snap, flags);
+        if (rc == 2) rewritten++;
+        else if (rc == 1) in_place++;
+        else if (rc == 0) unchanged++;
+        else failed++;
+        free(snap.v2);
+    }
+
+    if (count > 0 && matched < wanted_count)
+    {
+        printf(YELLOW "Warning: %d requested file(s) have no snapshot in %s\n" RESET, wanted_count - matched, archive);
+        failed += wanted_count - matched;
+    }
+
+    printf("%sRollback: %d restored in place, %d rewritten, %d unchanged, %d failed%s\n",
+           failed ? YELLOW : GREEN, in_place, rewritten, unchanged, failed, RESET);
+
+    for (int i = 0; i < n; i++) free(index[i].path);
+    free(index);
+    for (int i = 0; i < wanted_count; i++) free(wanted[i]);
+    free(wanted);
+    fclose(in);
+
+    return failed ? FAILURE : SUCCESS;
+}
\ No newline at end of file
@@ -34,6 +34,125 @@ void write_synchsafe_int(int value, unsigned char *bytes)
     bytes[3] = value & 0x7F;
 }
 
+// Length of the valid UTF-8 sequence starting at s, or 0 if the bytes are not valid UTF-8
+int utf8_char_len(const unsigned char *s)
+{
+    if (s[0] < 0x80) return 1;
+    if (s[0] >= 0xC2 && s[0] <= 0xDF)
+        return (s[1] & 0xC0) == 0x80 ? 2 : 0;
+    if (s[0] >= 0xE0 && s[0] <= 0xEF)
+    {
+        if ((s[1] & 0xC0) != 0x80 || (s[2] & 0xC0) != 0x80) return 0;
+        if (s[0] == 0xE0 && s[1] < 0xA0) return 0; // Overlong
+        if (s[0] == 0xED && s[1] >= 0xA0) return 0; // Surrogate
+        return 3;
+    }
+    if (s[0] >= 0xF0 && s[0] <= 0xF4)
+    {
+        if ((s[1] & 0xC0) != 0x80 || (s[2] & 0xC0) != 0x80 || (s[3] & 0xC0) != 0x80) return 0;
+        if (s[0] == 0xF0 && s[1] < 0x90) return 0; // Overlong
+        if (s[0] == 0xF4 && s[1] >= 0x90) return 0; // Above U+10FFFF
+        return 4;
+    }
+    return 0;
+}
+
+// Writes one code point as UTF-8; returns bytes written, 0 if it does not fit
+static int put_utf8(unsigned int cp, char *out, int room)
+{
+    if (cp < 0x80 && room >= 1) { out[0] = (char)cp; return 1; }
+    if (cp < 0x800 && room >= 2)
+    {
+        out[0] = (char)(0xC0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp >= 0x800 && cp < 0x10000 && room >= 3)
+    {
+        out[0] = (char)(0xE0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    if (cp >= 0x10000 && room >= 4)
+    {
+        out[0] = (char)(0xF0 | (cp >> 18));
+        out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+        out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[3] = (char)(0x80 | (cp & 0x3F));
+        return 4;
+    }
+    return 0;
+}
+
+// Converts ID3v2 text (encoding 0 ISO-8859-1, 1 UTF-16 BOM, 2 UTF-16BE, 3 UTF-8) to UTF-8
+int decode_id3_text(int encoding, const unsigned char *data, int len, char *out, int out_size)
+{
+    int o = 0;
+    if (out_size <= 0) return 0;
+
+    if (encoding == 1 || encoding == 2)
+    {
+        int big_endian = 1;
+        int i = 0;
+        if (encoding == 1 && len >= 2 && data[0] == 0xFF && data[1] == 0xFE) { big_endian = 0; i = 2; }
+        else if (encoding == 1 && len >= 2 && data[0] == 0xFE && data[1] == 0xFF) { i = 2; }
+
+        while (i + 1 < len)
+        {
+            unsigned int u = big_endian ? (data[i] << 8) | data[i + 1] : (data[i + 1] << 8) | data[i];
+            i += 2;
+            if (u == 0) break;
+
+            if (u >= 0xD800 && u <= 0xDBFF && i + 1 < len)
+            {
+                unsigned int lo = big_endian ? (data[i] << 8) | data[i + 1] : (data[i + 1] << 8) | data[i];
+                if (lo >= 0xDC00 && lo <= 0xDFFF)
+                {
+                    u = 0x10000 + ((u - 0xD800) << 10) + (lo - 0xDC00);
+                    i += 2;
+                }
+                else u = 0xFFFD;
+            }
+            else if (u >= 0xD800 && u <= 0xDFFF) u = 0xFFFD;
+
+            int n = put_utf8(u, out + o, out_size - 1 - o);
+            if (n == 0) break;
+            o += n;
+        }
+    }
+    else
+    {
+        int n = 0;
+        while (n < len && data[n]) n++;
+
+        // Encoding 0 often holds UTF-8 anyway (this tool writes it that way); keep it if valid
+        int valid = 1;
+        for (int i = 0; valid && i < n; )
+        {
+            unsigned char seq[4] = {0};
+            memcpy(seq, &data[i], n - i < 4 ? n - i : 4);
+            int step = utf8_char_len(seq);
+            if (step == 0) valid = 0;
+            i += step;
+        }
+
+        for (int i = 0; i < n; )
+        {
+            int step = valid ? utf8_char_len(&data[i]) : 1;
+            int w = 0;
+            if (valid && o + step < out_size) { memcpy(out + o, &data[i], step); w = step; }
+            else if (!valid) w = put_utf8(data[i], out + o, out_size - 1 - o);
+            if (w == 0) break;
+            o += w;
+            i += step;
+        }
+    }
+
+    out[o] = '\0';
+    return o;
+}
+
 // Helper function to get the ID3 version from the file header
 int get_mp3_version(FILE *fp)
 {